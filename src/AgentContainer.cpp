@@ -4,6 +4,10 @@
 
 #include "AgentContainer.H"
 
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
 using namespace amrex;
 using namespace ExaEpi::Utils;
 
@@ -28,6 +32,15 @@ void AgentContainer::add_attributes()
         }
         Print() << "Added " << count << " integer-type run-time SoA attibute(s).\n";
     }
+    {
+        // group indices are tile-local and recomputed after agents move, so they are not communicated
+        int count(0);
+        for (int i = 0; i < IntIdxGroup::nattribs; i++) {
+            AddIntComp(false);
+            count++;
+        }
+        Print() << "Added " << count << " integer-type run-time SoA group attibute(s).\n";
+    }
 }
 
 /*! Constructor:
@@ -63,6 +76,9 @@ AgentContainer::AgentContainer (const amrex::Geometry            & a_geom,  /*!<
         amrex::ParmParse pp("agent");
         pp.query("shelter_compliance", m_shelter_compliance);
         pp.query("symptomatic_withdraw_compliance", m_symptomatic_withdraw_compliance);
+        pp.query("tile_split_size", m_tile_split_size);
+        pp.query("hazard_accumulation", m_hazard_accumulation);
+        pp.query("attribute_infections", m_attribute_infections);
         int stratio[SchoolType::total];
         for (unsigned int i = 0; i < SchoolType::total; i++) {
             stratio[i] = m_student_teacher_ratio[i];
@@ -84,12 +100,70 @@ AgentContainer::AgentContainer (const amrex::Geometry            & a_geom,  /*!<
         m_interactions[InteractionNames::school] = new InteractionModSchool<PCType, PTDType, PType>(fast);
         m_interactions[InteractionNames::home_nborhood] = new InteractionModHomeNborhood<PCType, PTDType, PType>(fast);
         m_interactions[InteractionNames::work_nborhood] = new InteractionModWorkNborhood<PCType, PTDType, PType>(fast);
+        m_interactions[InteractionNames::airTravel] = new InteractionModAirTravel<PCType, PTDType, PType>(fast);
+
+        amrex::ParmParse pp("agent");
+        bool transit = false;
+        pp.query("transit_interactions", transit);
+        if (transit) {
+            m_interactions[InteractionNames::transit] = new InteractionModTransit<PCType, PTDType, PType>(fast);
+        }
+        Real venue_prob = 0.0_rt;
+        pp.query("venue_prob", venue_prob);
+        if (venue_prob > 0.0_rt) {
+            Long seed = 0;
+            pp.query("seed", seed);
+            m_interactions[InteractionNames::venue] = new InteractionModVenue<PCType, PTDType, PType>(fast, venue_prob, seed);
+        }
+
+        /* Select the interaction engine of each model; agent.interaction_engine sets the default
+           for all models, agent.interaction_engine_<model> overrides it for a single model */
+        std::string engine_name = "count";
+        pp.query("interaction_engine", engine_name);
+        pp.query("benchmark_interactions", m_benchmark_interactions);
+        pp.query("fuse_interactions", m_fuse_interactions);
+        pp.query("sort_agents", m_sort_agents);
+        for (auto& model : m_interactions) {
+            std::string model_engine_name = engine_name;
+            bool overridden = pp.query(("interaction_engine_" + interactionName(model.first)).c_str(), model_engine_name);
+            int model_engine = interactionEngine(model_engine_name);
+            // the models without a contact graph use the count engine, unless the network engine is requested for them
+            if (model_engine == InteractionEngine::network && contactGraphKind(model.first) < 0) {
+                if (overridden) {
+                    amrex::Abort("The network interaction engine is not available for the " + interactionName(model.first) + " model");
+                }
+                model_engine = InteractionEngine::count;
+            }
+            model.second->setEngine(model_engine);
+        }
+
+        /* Select the engine each model is compared with if the interactions are benchmarked; agent.benchmark_engine
+           sets it for all models (default: pairwise for the models using the count engine, count otherwise) */
+        if (m_benchmark_interactions) {
+            std::string benchmark_engine_name;
+            bool explicit_engine = pp.query("benchmark_engine", benchmark_engine_name);
+            for (auto& model : m_interactions) {
+                int engine = model.second->engine();
+                int other_engine = (engine == InteractionEngine::count) ? InteractionEngine::pairwise : InteractionEngine::count;
+                if (explicit_engine) { other_engine = interactionEngine(benchmark_engine_name); }
+                if (other_engine == engine) {
+                    amrex::Abort("agent.benchmark_engine must differ from the interaction engine of the "
+                                 + interactionName(model.first) + " model");
+                }
+                if (other_engine == InteractionEngine::network && contactGraphKind(model.first) < 0) {
+                    amrex::Abort("The network interaction engine is not available for the " + interactionName(model.first)
+                                 + " model, so it cannot be benchmarked against it");
+                }
+                m_benchmark_engines[model.first] = other_engine;
+            }
+        }
 
         m_hospital = std::make_unique<HospitalModel<PCType, PTDType, PType>>(fast);
     }
 
     m_h_parm.resize(m_num_diseases);
     m_d_parm.resize(m_num_diseases);
+    m_d_parm_asymp.resize(m_num_diseases);
 
     for (int d = 0; d < m_num_diseases; d++) {
         m_h_parm[d] = new DiseaseParm{a_disease_names[d]};
@@ -106,11 +180,31 @@ AgentContainer::AgentContainer (const amrex::Geometry            & a_geom,  /*!<
 #else
         std::memcpy(m_d_parm[d], m_h_parm[d], sizeof(DiseaseParm));
 #endif
+
+        // asymptomatic infectious agents are less infectious
+        DiseaseParm asymp_parm = *m_h_parm[d];
+        asymp_parm.scaleTransmission(asymp_parm.asymp_relative_inf);
+        m_d_parm_asymp[d] = (DiseaseParm*)amrex::The_Arena()->alloc(sizeof(DiseaseParm));
+#ifdef AMREX_USE_GPU
+        amrex::Gpu::htod_memcpy(m_d_parm_asymp[d], &asymp_parm, sizeof(DiseaseParm));
+#else
+        std::memcpy(m_d_parm_asymp[d], &asymp_parm, sizeof(DiseaseParm));
+#endif
     }
 
     max_attribute_values.fill(-1);
 }
 
+/*! \brief Destructor: frees the disease parameters */
+AgentContainer::~AgentContainer ()
+{
+    for (int d = 0; d < m_num_diseases; d++) {
+        delete m_h_parm[d];
+        amrex::The_Arena()->free(m_d_parm[d]);
+        amrex::The_Arena()->free(m_d_parm_asymp[d]);
+    }
+}
+
 /*! \brief Send agents on a random walk around the neighborhood
 
     For each agent, set its position to a random one near its current position
@@ -148,7 +242,8 @@ void AgentContainer::moveAgentsRandomWalk ()
 
 /*! \brief Move agents to work
 
-    For each agent, set its position to the work community (IntIdx::work_i, IntIdx::work_j)
+    For each agent, set its position to the work community (IntIdx::work_i, IntIdx::work_j);
+    agents on air travel stay at their destination (see moveAirTravel())
 */
 void AgentContainer::moveAgentsToWork ()
 {
@@ -181,7 +276,7 @@ void AgentContainer::moveAgentsToWork ()
             amrex::ParallelFor( np,
             [=] AMREX_GPU_DEVICE (int ip) noexcept
             {
-                if (!inHospital(ip, ptd)) {
+                if (!inHospital(ip, ptd) && !onAirTravel(ip, ptd)) {
                     ParticleType& p = pstruct[ip];
                     if (is_census) { // using census data
                         p.pos(0) = static_cast<ParticleReal>((work_i_ptr[ip] + 0.5_rt) * dx[0]);
@@ -199,13 +294,14 @@ void AgentContainer::moveAgentsToWork ()
 
     m_at_work = true;
 
-    Redistribute();
+    redistributeAgents();
     AMREX_ASSERT(OK());
 }
 
 /*! \brief Move agents to home
 
-    For each agent, set its position to the home community (IntIdx::home_i, IntIdx::home_j)
+    For each agent, set its position to the home community (IntIdx::home_i, IntIdx::home_j);
+    agents on air travel stay at their destination (see moveAirTravel())
 */
 void AgentContainer::moveAgentsToHome ()
 {
@@ -238,7 +334,7 @@ void AgentContainer::moveAgentsToHome ()
             amrex::ParallelFor( np,
             [=] AMREX_GPU_DEVICE (int ip) noexcept
             {
-                if (!inHospital(ip, ptd)) {
+                if (!inHospital(ip, ptd) && !onAirTravel(ip, ptd)) {
                     ParticleType& p = pstruct[ip];
                     if (is_census) { // using census data
                         p.pos(0) = static_cast<ParticleReal>((home_i_ptr[ip] + 0.5_rt) * dx[0]);
@@ -256,7 +352,7 @@ void AgentContainer::moveAgentsToHome ()
 
     m_at_work = false;
 
-    Redistribute();
+    redistributeAgents();
     AMREX_ASSERT(OK());
 }
 
@@ -311,15 +407,24 @@ void AgentContainer::moveRandomTravel (const amrex::Real random_travel_prob)
 
 /*! \brief Select agents to travel by air
 
+    Each selected agent is moved to its destination community (IntIdx::trav_i, IntIdx::trav_j, see
+    setAirTravel()), where it stays until returnAirTravel() and interacts with the residents
+    (see InteractionModAirTravel).
 */
-void AgentContainer::moveAirTravel (const iMultiFab& unit_mf, AirTravelFlow& air, DemographicData& demo)
+void AgentContainer::moveAirTravel (const iMultiFab& unit_mf, AirTravelFlow& air, DemographicData& /*demo*/)
 {
     BL_PROFILE("AgentContainer::moveAirTravel");
+    Long num_travelers = 0;
     for (int lev = 0; lev <= finestLevel(); ++lev)
     {
         auto& plev  = GetParticles(lev);
+        const auto dx = Geom(lev).CellSizeArray();
+
+        bool is_census = (ic_type == ExaEpi::ICType::Census);
+        auto grid_to_lnglat_ptr = &grid_to_lnglat;
+
 #ifdef AMREX_USE_OMP
-#pragma omp parallel if (Gpu::notInLaunchRegion())
+#pragma omp parallel if (Gpu::notInLaunchRegion()) reduction(+:num_travelers)
 #endif
         for(MFIter mfi = MakeMFIter(lev); mfi.isValid(); ++mfi)
         {
@@ -343,18 +448,34 @@ void AgentContainer::moveAirTravel (const iMultiFab& unit_mf, AirTravelFlow& air
             [=] AMREX_GPU_DEVICE (int i, RandomEngine const& engine) noexcept
             {
                 int unit = unit_arr(home_i_ptr[i], home_j_ptr[i], 0);
-                if (!inHospital(i, ptd) && random_travel_ptr[i] <0 && air_travel_ptr[i] <0) {
+                // agents without a destination (see setAirTravel()) do not travel
+                if (!inHospital(i, ptd) && random_travel_ptr[i] <0 && air_travel_ptr[i] <0 && trav_i_ptr[i] >= 0) {
                     if (withdrawn_ptr[i] == 1) {return ;}
                     if (amrex::Random(engine) < air_travel_prob_ptr[unit]) {
                                 ParticleType& p = pstruct[i];
-                                p.pos(0) = trav_i_ptr[i];
-                                p.pos(1) = trav_j_ptr[i];
+                                if (is_census) { // using census data
+                                    p.pos(0) = static_cast<ParticleReal>((trav_i_ptr[i] + 0.5_rt) * dx[0]);
+                                    p.pos(1) = static_cast<ParticleReal>((trav_j_ptr[i] + 0.5_rt) * dx[1]);
+                                } else {
+                                    Real lng, lat;
+                                    (*grid_to_lnglat_ptr)(trav_i_ptr[i], trav_j_ptr[i], lng, lat);
+                                    p.pos(0) = static_cast<ParticleReal>(lng);
+                                    p.pos(1) = static_cast<ParticleReal>(lat);
+                                }
                                 air_travel_ptr[i] = i;
                     }
                 }
             });
+
+            num_travelers += Reduce::Sum<Long>(np, [=] AMREX_GPU_DEVICE (int i) noexcept -> Long {
+                return air_travel_ptr[i] >= 0;
+            });
        }
     }
+
+    // the air travel interactions only run on the nights with travelers
+    ParallelDescriptor::ReduceLongSum(num_travelers);
+    m_on_air_travel = (num_travelers > 0);
 }
 
 void AgentContainer::setAirTravel (const iMultiFab& unit_mf, AirTravelFlow& air, DemographicData& demo)
@@ -499,7 +620,7 @@ void AgentContainer::returnRandomTravel ()
             });
         }
     }
-    Redistribute();
+    redistributeAgents();
     AMREX_ALWAYS_ASSERT(OK());
 }
 
@@ -550,7 +671,9 @@ void AgentContainer::returnAirTravel ()
             });
         }
     }
-    Redistribute();
+    m_on_air_travel = false;
+
+    redistributeAgents();
     AMREX_ALWAYS_ASSERT(OK());
 }
 
@@ -562,6 +685,7 @@ void AgentContainer::updateStatus ( MFPtrVec& a_disease_stats /*!< Community-wis
 
     m_disease_status.updateAgents(*this, a_disease_stats);
     m_hospital->treatAgents(*this, a_disease_stats);
+    m_infectious_indices_valid = false;
 
     // move hospitalized agents to their hospital location
     for (int lev = 0; lev <= finestLevel(); ++lev)
@@ -678,15 +802,32 @@ void AgentContainer::shelterStop ()
 
 /*! \brief Infect agents based on their current status and the computed probability of infection.
     The infection probability is computed in AgentContainer::interactAgentsHomeWork() or
-    AgentContainer::interactAgents() */
+    AgentContainer::interactAgents()
+
+    If infections are attributed (see attributeInfections()), an #InfectionEvent is appended to the
+    events of the tile (see getInfectionEvents()) for each newly infected agent, with the setting and
+    the infector sampled by the interaction models during the day (see #AttributionSampler); the
+    events are compacted with one prefix sum per disease, which also resets the samples. */
 void AgentContainer::infectAgents ()
 {
     BL_PROFILE("AgentContainer::infectAgents");
+    m_infectious_indices_valid = false;
+    const bool attribute = m_attribute_infections;
+    m_infection_events.resize(finestLevel()+1);
 
     for (int lev = 0; lev <= finestLevel(); ++lev)
     {
         auto& plev  = GetParticles(lev);
 
+        if (attribute) {
+            // create the entries for all the tiles first, so that the map is not modified in the parallel region
+            for (MFIter mfi = MakeMFIter(lev); mfi.isValid(); ++mfi) {
+                m_infection_events[lev][std::make_pair(mfi.index(), mfi.LocalTileIndex())];
+            }
+            // each thread needs its own buffers
+            m_scratch.prepare();
+        }
+
 #ifdef AMREX_USE_OMP
 #pragma omp parallel if (Gpu::notInLaunchRegion())
 #endif
@@ -702,6 +843,12 @@ void AgentContainer::infectAgents ()
             int r_RT = RealIdx::nattribs;
             int n_disease = m_num_diseases;
 
+            // agents infected by this call, for the infection events
+            int* new_infection_ptr = nullptr;
+            if (attribute) {
+                new_infection_ptr = m_scratch.get<int>(ScratchArena::new_infections, static_cast<std::size_t>(np));
+            }
+
             for (int d = 0; d < n_disease; d++) {
 
                 auto status_ptr = soa.GetIntData(i_RT+i0(d)+IntIdxDisease::status).data();
@@ -713,20 +860,59 @@ void AgentContainer::infectAgents ()
                 auto incubation_period_ptr = soa.GetRealData(r_RT+r0(d)+RealIdxDisease::incubation_period).data();
 
                 const auto lparm = m_d_parm[d];
+                const bool hazard = m_hazard_accumulation;
 
                 amrex::ParallelForRNG( np,
                 [=] AMREX_GPU_DEVICE (int i, amrex::RandomEngine const& engine) noexcept
                 {
-                    prob_ptr[i] = 1.0_prt - prob_ptr[i];
+                    // convert the probability (or its logarithm) of not being infected to the infection probability
+                    if (hazard) {
+                        prob_ptr[i] = -std::expm1(prob_ptr[i]);
+                    } else {
+                        prob_ptr[i] = 1.0_prt - prob_ptr[i];
+                    }
+                    if (new_infection_ptr) { new_infection_ptr[i] = 0; }
                     if ( status_ptr[i] == Status::never ||
                          status_ptr[i] == Status::susceptible ) {
                         if (amrex::Random(engine) < prob_ptr[i]) {
                             setInfected(&(status_ptr[i]), &(counter_ptr[i]), &(latent_period_ptr[i]), &(infectious_period_ptr[i]),
                                         &(incubation_period_ptr[i]), engine, lparm);
+                            if (new_infection_ptr) { new_infection_ptr[i] = 1; }
                             return;
                         }
                     }
                 });
+
+                if (attribute) {
+                    const auto& ptd = ptile.getParticleTileData();
+                    auto setting_ptr      = soa.GetIntData(i_RT+i0(d)+IntIdxDisease::infection_setting).data();
+                    auto infector_id_ptr  = soa.GetIntData(i_RT+i0(d)+IntIdxDisease::infector_id).data();
+                    auto infector_cpu_ptr = soa.GetIntData(i_RT+i0(d)+IntIdxDisease::infector_cpu).data();
+
+                    auto& events = m_infection_events[lev].at(std::make_pair(gid, tid));
+                    const auto num_old = events.size();
+                    events.resize(num_old + np);
+                    auto events_ptr = events.data() + num_old;
+                    int num_new = Scan::PrefixSum<int>(static_cast<int>(np),
+                        [=] AMREX_GPU_DEVICE (int i) -> int { return new_infection_ptr[i]; },
+                        [=] AMREX_GPU_DEVICE (int i, int const& x) {
+                            if (new_infection_ptr[i]) {
+                                const auto& p = ptd.m_aos[i];
+                                const bool sampled = (setting_ptr[i] >= 0);
+                                events_ptr[x] = InfectionEvent{static_cast<int>(p.id()), static_cast<int>(p.cpu()),
+                                                               sampled ? infector_id_ptr[i] : -1,
+                                                               sampled ? infector_cpu_ptr[i] : -1,
+                                                               static_cast<short>(d),
+                                                               static_cast<short>(sampled ? setting_ptr[i] : -1)};
+                            }
+                            // the samples of the next day start afresh
+                            setting_ptr[i] = -1;
+                            infector_id_ptr[i] = -1;
+                            infector_cpu_ptr[i] = -1;
+                        },
+                        Scan::Type::exclusive, Scan::retSum);
+                    events.resize(num_old + num_new);
+                }
             }
         }
     }
@@ -844,70 +1030,795 @@ int AgentContainer::getMaxGroup (const int group_idx) {
     return max_attribute_values[group_idx];
 }
 
+/*! \brief Build the cell-to-local-community maps used by the interaction models
+
+    Communities do not change after the agents are initialized, so the map of each tile
+    (see #CommunityIndexMap) is built once and reused by all the interaction models every day.
+    The maps are rebuilt only if the box array or distribution mapping of the agents has
+    changed since they were last built; in that case, #AgentContainer::comm_mf is first
+    copied onto the new box array.
+*/
+void AgentContainer::buildCommunityIndex ()
+{
+    BL_PROFILE("AgentContainer::buildCommunityIndex");
+
+    int nlevs = finestLevel() + 1;
+    m_comm_index.resize(nlevs);
+    m_comm_index_ba.resize(nlevs);
+    m_comm_index_dm.resize(nlevs);
+
+    for (int lev = 0; lev < nlevs; ++lev)
+    {
+        const auto& ba = ParticleBoxArray(lev);
+        const auto& dm = ParticleDistributionMap(lev);
+        if (!m_comm_index[lev].empty() && m_comm_index_ba[lev] == ba && m_comm_index_dm[lev] == dm) {
+            continue;
+        }
+
+        AMREX_ALWAYS_ASSERT(comm_mf.ok());
+        const iMultiFab* comm_mf_ptr = &comm_mf;
+        iMultiFab comm_mf_tmp;
+        if (comm_mf.boxArray() != ba || comm_mf.DistributionMap() != dm) {
+            comm_mf_tmp.define(ba, dm, 1, 0);
+            comm_mf_tmp.setVal(-1);
+            comm_mf_tmp.ParallelCopy(comm_mf);
+            comm_mf_ptr = &comm_mf_tmp;
+        }
+
+        m_comm_index[lev].clear();
+        for (MFIter mfi = MakeMFIter(lev); mfi.isValid(); ++mfi) {
+            auto& comm_map = m_comm_index[lev][std::make_pair(mfi.index(), mfi.LocalTileIndex())];
+            comm_map.build(mfi.tilebox(), comm_mf_ptr->const_array(mfi));
+        }
+
+        m_comm_index_ba[lev] = ba;
+        m_comm_index_dm[lev] = dm;
+        m_comm_scale_valid = false;
+    }
+}
+
+/*! \brief Build the table of the transmission scale of each local community of each tile
+
+    The scale of a community is the value of a_mask_behavior in its cell; it multiplies the
+    transmission probabilities of the contacts outside the family of the agents in that community
+    (see interactGroupsImpl() and interactAgentsImpl()). The interaction kernels read it through
+    the cached local community index of each agent (see #IntIdxGroup::community), so that spatially
+    varying behavior (masking, interventions, density) costs no extra pass over the agents.
+
+    For hazard accumulation, the logarithms of the scaled probabilities of not being infected,
+    log(1 - (1 - vac_eff) * xmit * scale), are also tabulated for each community, disease,
+    infectiousness class and transmission probability (see AgentContainer::getCommunityLogXmit()),
+    so that the count engine adds count * log(1 - p) for the scaled probability p without computing
+    a logarithm per agent.
+
+    The tables are rebuilt only if they are out of date, i.e., once a day (see AgentContainer::morningCommute())
+    or if the community maps have been rebuilt (see AgentContainer::buildCommunityIndex()).
+*/
+void AgentContainer::updateCommunityScale (const MultiFab& a_mask_behavior /*!< Masking behavior */)
+{
+    if (m_comm_scale_valid) { return; }
+
+    BL_PROFILE("AgentContainer::updateCommunityScale");
+
+    buildCommunityIndex();
+
+    int nlevs = finestLevel() + 1;
+    m_comm_scale.resize(nlevs);
+    m_comm_log_xmit.resize(nlevs);
+
+    // unscaled probabilities (1 - vac_eff) * xmit for each disease, infectiousness class and
+    // transmission probability (see AgentContainer::getAsympDiseaseParameters_d())
+    const int num_xmit = m_num_diseases * InfectiousnessClass::total * ScaledXmit::total;
+    Vector<Real> xmit_h(num_xmit);
+    for (int d = 0; d < m_num_diseases; d++) {
+        DiseaseParm asymp_parm = *m_h_parm[d];
+        asymp_parm.scaleTransmission(asymp_parm.asymp_relative_inf);
+        const Real infect = 1.0_rt - m_h_parm[d]->vac_eff;
+        for (int k = 0; k < ScaledXmit::total; k++) {
+            xmit_h[(d * InfectiousnessClass::total + InfectiousnessClass::full) * ScaledXmit::total + k]
+                = infect * m_h_parm[d]->scaledXmit(k);
+            xmit_h[(d * InfectiousnessClass::total + InfectiousnessClass::asymptomatic) * ScaledXmit::total + k]
+                = infect * asymp_parm.scaledXmit(k);
+        }
+    }
+    Gpu::DeviceVector<Real> xmit_d(num_xmit);
+    Gpu::copyAsync(Gpu::hostToDevice, xmit_h.begin(), xmit_h.end(), xmit_d.begin());
+    Gpu::streamSynchronize();
+    auto xmit_ptr = xmit_d.data();
+
+    for (int lev = 0; lev < nlevs; ++lev)
+    {
+        const auto& ba = ParticleBoxArray(lev);
+        const auto& dm = ParticleDistributionMap(lev);
+        const MultiFab* mask_ptr = &a_mask_behavior;
+        MultiFab mask_tmp;
+        if (a_mask_behavior.boxArray() != ba || a_mask_behavior.DistributionMap() != dm) {
+            mask_tmp.define(ba, dm, 1, 0);
+            mask_tmp.setVal(1.0_rt);
+            mask_tmp.ParallelCopy(a_mask_behavior, 0, 0, 1);
+            mask_ptr = &mask_tmp;
+        }
+
+        // create the entries for all the tiles first, so that the map is not modified in the parallel region
+        for (MFIter mfi = MakeMFIter(lev); mfi.isValid(); ++mfi) {
+            m_comm_scale[lev][std::make_pair(mfi.index(), mfi.LocalTileIndex())];
+            m_comm_log_xmit[lev][std::make_pair(mfi.index(), mfi.LocalTileIndex())];
+        }
+
+#ifdef AMREX_USE_OMP
+#pragma omp parallel if (Gpu::notInLaunchRegion())
+#endif
+        for (MFIter mfi = MakeMFIter(lev); mfi.isValid(); ++mfi) {
+            const auto& comm_map = getCommunityIndexMap(lev, mfi);
+            auto& comm_scale = m_comm_scale[lev].at(std::make_pair(mfi.index(), mfi.LocalTileIndex()));
+            // at least one entry, so that the table can always be indexed by the kernels
+            comm_scale.resize(std::max(comm_map.num_comms, 1), 1.0_rt);
+            auto comm_scale_ptr = comm_scale.data();
+            auto local_index_ptr = comm_map.comm_to_local_index_d.data();
+            auto mask_arr = mask_ptr->const_array(mfi);
+            const Box bx = mfi.tilebox();
+            const IntVect bin_size = {AMREX_D_DECL(1, 1, 1)};
+            ParallelFor(bx, [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept {
+                Box tbx;
+                auto ti = getTileIndex(IntVect(AMREX_D_DECL(i, j, k)), bx, true, bin_size, tbx);
+                int local_index = local_index_ptr[ti];
+                if (local_index >= 0) { comm_scale_ptr[local_index] = static_cast<Real>(mask_arr(i, j, k)); }
+            });
+            Gpu::synchronize();
+
+            // kept finite, as DiseaseParm::log_xmit_work etc., so that multiplying them by a zero count gives zero
+            auto& comm_log_xmit = m_comm_log_xmit[lev].at(std::make_pair(mfi.index(), mfi.LocalTileIndex()));
+            comm_log_xmit.resize(comm_scale.size() * num_xmit);
+            auto log_xmit_ptr = comm_log_xmit.data();
+            ParallelFor(static_cast<int>(comm_log_xmit.size()), [=] AMREX_GPU_DEVICE (int e) noexcept {
+                const Real scale = comm_scale_ptr[e / num_xmit];
+                log_xmit_ptr[e] = amrex::max(std::log1p(-amrex::min(xmit_ptr[e % num_xmit] * scale, 1.0_rt)),
+                                             std::numeric_limits<Real>::lowest());
+            });
+            Gpu::synchronize();
+        }
+    }
+
+    m_comm_scale_valid = true;
+}
+
+/*! \brief Redistribute agents among tiles and processes
+
+    Calls Redistribute() and flags the interaction group indices (#IntIdxGroup) and the lists of
+    infectious agents as out of date, since agents may have moved to a different tile or been
+    reordered within one.
+*/
+void AgentContainer::redistributeAgents ()
+{
+    BL_PROFILE("AgentContainer::redistributeAgents");
+    Redistribute();
+    m_group_indices_valid = false;
+    m_infectious_indices_valid = false;
+}
+
+/*! \brief Compute the interaction group indices (#IntIdxGroup) of all agents
+
+    Each interaction group key (e.g. community, workgroup and NAICS code for workgroups) is mapped
+    to a dense, tile-local group index (see buildDenseGroupIndex()) and stored in the runtime
+    int-type attributes of the agents, so that the interaction kernels read a single contiguous
+    integer per agent and setting. The number of groups of each kind in each tile is stored as well
+    (see AgentContainer::getNumGroups()).
+
+    Only the groups of the current phase of the day are computed (work, school and work neighborhood
+    groups if agents are at work; family, neighborhood cluster and neighborhood groups otherwise),
+    and only if agents have been redistributed since the last time this function was called.
+
+    At work, the agents that belong to a workgroup or a school are also listed for each tile (see
+    AgentContainer::getGroupMembers()), so that the work and school models only visit their members.
+    Membership never changes during a run, but the lists follow the agents across tiles.
+
+    If the transit model is used (see InteractionModTransit), the agents that commute to another
+    community are grouped by (home community, work community) in both phases, and listed as well.
+    The agents of a group share their home and work cells, so they are in the same tile either way.
+
+    The contact graphs of the models that use the network engine (see ExaEpi::contactGraphKind())
+    are rebuilt from the groups of the current phase as well (see AgentContainer::getContactGraph()):
+    the contacts never change, but their tile-local indices do.
+*/
+void AgentContainer::updateGroupIndices ()
+{
+    if (m_group_indices_valid) { return; }
+
+    BL_PROFILE("AgentContainer::updateGroupIndices");
+
+    buildCommunityIndex();
+
+    int nlevs = finestLevel() + 1;
+    m_num_groups.resize(nlevs);
+    m_group_members.resize(nlevs);
+    m_contact_graphs.resize(nlevs);
+
+    const Long max_family = getMaxGroup(IntIdx::family) + 1;
+    const Long num_ncs = max_family / FAMILIES_PER_CLUSTER + 1;
+    const Long max_nborhood = std::max(getMaxGroup(IntIdx::nborhood), getMaxGroup(IntIdx::work_nborhood)) + 1;
+    const Long max_workgroup = getMaxGroup(IntIdx::workgroup) + 1;
+    const Long max_naics = getMaxGroup(IntIdx::naics) + 1;
+    const Long max_school_id = getMaxGroup(IntIdx::school_id) + 1;
+    const Long max_school_grade = getMaxGroup(IntIdx::school_grade) + 1;
+    const bool at_work = m_at_work;
+    const bool transit = haveInteractionModel(ExaEpi::InteractionNames::transit);
+
+    // kinds of groups whose contact graph is used by the network engine
+    std::array<bool, IntIdxGroup::nattribs> network;
+    network.fill(false);
+    for (const auto& model : m_interactions) {
+        int kind = ExaEpi::contactGraphKind(model.first);
+        auto benchmark = m_benchmark_engines.find(model.first);
+        if (kind >= 0 && (model.second->engine() == ExaEpi::InteractionEngine::network ||
+                          (benchmark != m_benchmark_engines.end() && benchmark->second == ExaEpi::InteractionEngine::network))) {
+            network[kind] = true;
+        }
+    }
+    const int ig = IntIdx::nattribs + g0(m_num_diseases);
+
+    for (int lev = 0; lev < nlevs; ++lev)
+    {
+        const Long ncells_i = Geom(lev).Domain().length(0);
+        const Long ncells = Geom(lev).Domain().numPts();
+
+        // create the entries for all the tiles first, so that the map is not modified in the parallel region
+        for (MFIter mfi = MakeMFIter(lev); mfi.isValid(); ++mfi) {
+            m_num_groups[lev][std::make_pair(mfi.index(), mfi.LocalTileIndex())].fill(0);
+            m_group_members[lev][std::make_pair(mfi.index(), mfi.LocalTileIndex())];
+            m_contact_graphs[lev][std::make_pair(mfi.index(), mfi.LocalTileIndex())];
+        }
+        // each thread needs its own buffers
+        m_scratch.prepare();
+
+#ifdef AMREX_USE_OMP
+#pragma omp parallel if (Gpu::notInLaunchRegion())
+#endif
+        for (MFIter mfi = MakeMFIter(lev); mfi.isValid(); ++mfi) {
+            if (m_sort_agents) {
+                sortAgents(lev, mfi, max_family, max_nborhood, max_workgroup);
+            }
+
+            auto& ptile = ParticlesAt(lev, mfi);
+            const auto& ptd = ptile.getParticleTileData();
+            const auto np = ptile.GetArrayOfStructs().numParticles();
+            auto& num_groups = m_num_groups[lev].at(std::make_pair(mfi.index(), mfi.LocalTileIndex()));
+            auto& members = m_group_members[lev].at(std::make_pair(mfi.index(), mfi.LocalTileIndex()));
+            for (auto& members_d : members) { members_d.clear(); }
+            auto& graphs = m_contact_graphs[lev].at(std::make_pair(mfi.index(), mfi.LocalTileIndex()));
+            for (auto& graph : graphs) { graph.clear(); }
+            if (np == 0) continue;
+
+            auto& soa = ptile.GetStructOfArrays();
+            auto family_ptr = soa.GetIntData(IntIdx::family).data();
+            auto nborhood_ptr = soa.GetIntData(IntIdx::nborhood).data();
+            auto work_nborhood_ptr = soa.GetIntData(IntIdx::work_nborhood).data();
+            auto workgroup_ptr = soa.GetIntData(IntIdx::workgroup).data();
+            auto naics_ptr = soa.GetIntData(IntIdx::naics).data();
+            auto school_id_ptr = soa.GetIntData(IntIdx::school_id).data();
+            auto school_grade_ptr = soa.GetIntData(IntIdx::school_grade).data();
+            auto home_i_ptr = soa.GetIntData(IntIdx::home_i).data();
+            auto home_j_ptr = soa.GetIntData(IntIdx::home_j).data();
+            auto work_i_ptr = soa.GetIntData(IntIdx::work_i).data();
+            auto work_j_ptr = soa.GetIntData(IntIdx::work_j).data();
+
+            auto community_ptr = soa.GetIntData(ig + IntIdxGroup::community).data();
+            auto family_group_ptr = soa.GetIntData(ig + IntIdxGroup::family).data();
+            auto nc_group_ptr = soa.GetIntData(ig + IntIdxGroup::nc).data();
+            auto nborhood_group_ptr = soa.GetIntData(ig + IntIdxGroup::nborhood).data();
+            auto workgroup_group_ptr = soa.GetIntData(ig + IntIdxGroup::workgroup).data();
+            auto school_group_ptr = soa.GetIntData(ig + IntIdxGroup::school).data();
+            auto transit_group_ptr = soa.GetIntData(ig + IntIdxGroup::transit).data();
+
+            GetCommunityIndex<PTDType> getCommunityIndex(Geom(lev), mfi.tilebox(), getCommunityIndexMap(lev, mfi));
+            num_groups[IntIdxGroup::community] = getCommunityIndex.max();
+
+            amrex::ParallelFor(np, [=] AMREX_GPU_DEVICE (int i) noexcept
+            {
+                community_ptr[i] = getCommunityIndex(ptd, i);
+            });
+
+            if (at_work) {
+                num_groups[IntIdxGroup::workgroup] = buildDenseGroupIndex(np,
+                    [=] AMREX_GPU_DEVICE (int i) noexcept -> Long {
+                        if (workgroup_ptr[i] <= 0) { return -1; }
+                        return (community_ptr[i] * max_workgroup + workgroup_ptr[i]) * max_naics + naics_ptr[i];
+                    }, workgroup_group_ptr, m_tile_split_size, m_scratch);
+                num_groups[IntIdxGroup::school] = buildDenseGroupIndex(np,
+                    [=] AMREX_GPU_DEVICE (int i) noexcept -> Long {
+                        if (school_id_ptr[i] <= 0) { return -1; }
+                        return (community_ptr[i] * max_school_id + school_id_ptr[i]) * max_school_grade + school_grade_ptr[i];
+                    }, school_group_ptr, m_tile_split_size, m_scratch);
+                buildGroupMembers(static_cast<int>(np), workgroup_group_ptr, members[IntIdxGroup::workgroup]);
+                buildGroupMembers(static_cast<int>(np), school_group_ptr, members[IntIdxGroup::school]);
+                // always use work nborhood, because even age group 0 could be in another nborhood during the day for daycare
+                num_groups[IntIdxGroup::nborhood] = buildDenseGroupIndex(np,
+                    [=] AMREX_GPU_DEVICE (int i) noexcept -> Long {
+                        return community_ptr[i] * max_nborhood + work_nborhood_ptr[i];
+                    }, nborhood_group_ptr, m_tile_split_size, m_scratch);
+                amrex::ParallelFor(np, [=] AMREX_GPU_DEVICE (int i) noexcept
+                {
+                    family_group_ptr[i] = -1;
+                    nc_group_ptr[i] = -1;
+                });
+            } else {
+                num_groups[IntIdxGroup::family] = buildDenseGroupIndex(np,
+                    [=] AMREX_GPU_DEVICE (int i) noexcept -> Long {
+                        return community_ptr[i] * max_family + family_ptr[i];
+                    }, family_group_ptr, m_tile_split_size, m_scratch);
+                num_groups[IntIdxGroup::nc] = buildDenseGroupIndex(np,
+                    [=] AMREX_GPU_DEVICE (int i) noexcept -> Long {
+                        int cluster = family_ptr[i] / FAMILIES_PER_CLUSTER;
+                        return (community_ptr[i] * max_nborhood + nborhood_ptr[i]) * num_ncs + cluster;
+                    }, nc_group_ptr, m_tile_split_size, m_scratch);
+                num_groups[IntIdxGroup::nborhood] = buildDenseGroupIndex(np,
+                    [=] AMREX_GPU_DEVICE (int i) noexcept -> Long {
+                        return community_ptr[i] * max_nborhood + nborhood_ptr[i];
+                    }, nborhood_group_ptr, m_tile_split_size, m_scratch);
+                amrex::ParallelFor(np, [=] AMREX_GPU_DEVICE (int i) noexcept
+                {
+                    workgroup_group_ptr[i] = -1;
+                    school_group_ptr[i] = -1;
+                });
+            }
+            if (transit) {
+                num_groups[IntIdxGroup::transit] = buildDenseGroupIndex(np,
+                    [=] AMREX_GPU_DEVICE (int i) noexcept -> Long {
+                        Long home = home_j_ptr[i] * ncells_i + home_i_ptr[i];
+                        Long work = work_j_ptr[i] * ncells_i + work_i_ptr[i];
+                        if (home == work) { return -1; }
+                        return home * ncells + work;
+                    }, transit_group_ptr, m_tile_split_size, m_scratch);
+                buildGroupMembers(static_cast<int>(np), transit_group_ptr, members[IntIdxGroup::transit]);
+            } else {
+                amrex::ParallelFor(np, [=] AMREX_GPU_DEVICE (int i) noexcept
+                {
+                    transit_group_ptr[i] = -1;
+                });
+            }
+            for (int kind = 0; kind < IntIdxGroup::nattribs; ++kind) {
+                // only the groups of the current phase are valid
+                bool valid = (at_work ? (kind == IntIdxGroup::workgroup || kind == IntIdxGroup::school)
+                                      : (kind == IntIdxGroup::nc));
+                if (network[kind] && valid) {
+                    buildContactGraph(ptd, static_cast<int>(np), soa.GetIntData(ig + kind).data(),
+                                      num_groups[kind], graphs[kind]);
+                }
+            }
+            Gpu::synchronize();
+        }
+    }
+
+    m_group_indices_valid = true;
+    if (m_sort_agents) {
+        // the agents have moved within their tiles
+        m_infectious_indices_valid = false;
+    }
+}
+
+/*! \brief Sort the agents of a tile, so that the agents of each interaction group are contiguous
+
+    The agents are sorted by (community, workgroup) at work, and by (community, neighborhood, family)
+    otherwise. The groups are then numbered in the order of the agents (see buildDenseGroupIndex()),
+    so that the interaction models read and update the count tables mostly sequentially. On CPUs, the
+    composite keys are sorted with a stable sort; on GPUs, the agents are binned once per component
+    of the key.
+
+    This is called from updateGroupIndices(), i.e., only after the agents have been redistributed.
+*/
+void AgentContainer::sortAgents (int lev, /*!< level */
+                                 const MFIter& mfi, /*!< tile */
+                                 Long max_family, /*!< upper bound of the family IDs */
+                                 Long max_nborhood, /*!< upper bound of the neighborhood IDs */
+                                 Long max_workgroup /*!< upper bound of the workgroup IDs */)
+{
+    BL_PROFILE("AgentContainer::sortAgents");
+
+    auto& ptile = ParticlesAt(lev, mfi);
+    const auto& ptd = ptile.getParticleTileData();
+    const int np = static_cast<int>(ptile.numParticles());
+    if (np < 2) { return; }
+
+    GetCommunityIndex<PTDType> getCommunityIndex(Geom(lev), mfi.tilebox(), getCommunityIndexMap(lev, mfi));
+
+#ifdef AMREX_USE_GPU
+    // DenseBins is not stable on GPUs, so the agents are binned once per key component: first by
+    // community, then by the dense index of each finer group, which buildDenseGroupIndex() numbers
+    // in the order of the agents binned so far (e.g., the families of a neighborhood get consecutive
+    // indices). The dense indices are stored in a group component, which updateGroupIndices() overwrites.
+    const int ig = IntIdx::nattribs + g0(m_num_diseases);
+    const bool at_work = m_at_work;
+    const int npasses = at_work ? 2 : 3;
+    amrex::ignore_unused(ptd);
+    for (int pass = 0; pass < npasses; ++pass) {
+        auto& soa = ptile.GetStructOfArrays();
+        const auto& pass_ptd = ptile.getParticleTileData();
+        auto family_ptr = soa.GetIntData(IntIdx::family).data();
+        auto nborhood_ptr = soa.GetIntData(IntIdx::nborhood).data();
+        auto workgroup_ptr = soa.GetIntData(IntIdx::workgroup).data();
+        auto bin_ptr = soa.GetIntData(ig + IntIdxGroup::family).data();
+
+        int nbins = 0;
+        if (pass == 0) {
+            nbins = getCommunityIndex.max();
+            amrex::ParallelFor(np, [=] AMREX_GPU_DEVICE (int i) noexcept
+            {
+                bin_ptr[i] = amrex::max(getCommunityIndex(pass_ptd, i), 0);
+            });
+        } else {
+            nbins = buildDenseGroupIndex(np,
+                [=] AMREX_GPU_DEVICE (int i) noexcept -> Long {
+                    Long community = amrex::max(getCommunityIndex(pass_ptd, i), 0);
+                    if (at_work) { return community * max_workgroup + amrex::max(workgroup_ptr[i], 0); }
+                    Long key = community * max_nborhood + nborhood_ptr[i];
+                    return (pass == 1) ? key : key * max_family + family_ptr[i];
+                }, bin_ptr, m_tile_split_size, m_scratch);
+        }
+        DenseBins<PTDType> bins;
+        bins.build(BinPolicy::GPU, np, pass_ptd, amrex::max(nbins, 1),
+                   [=] AMREX_GPU_DEVICE (const PTDType&, int i) noexcept -> unsigned int {
+                       return static_cast<unsigned int>(bin_ptr[i]);
+                   });
+        ReorderParticles(lev, mfi, bins.permutationPtr());
+    }
+#else
+    auto& soa = ptile.GetStructOfArrays();
+    auto family_ptr = soa.GetIntData(IntIdx::family).data();
+    auto nborhood_ptr = soa.GetIntData(IntIdx::nborhood).data();
+    auto workgroup_ptr = soa.GetIntData(IntIdx::workgroup).data();
+    const bool at_work = m_at_work;
+
+    auto keys = m_scratch.get<Long>(ScratchArena::sort_keys, static_cast<std::size_t>(np));
+    for (int i = 0; i < np; ++i) {
+        Long community = amrex::max(getCommunityIndex(ptd, i), 0);
+        if (at_work) {
+            keys[i] = community * max_workgroup + amrex::max(workgroup_ptr[i], 0);
+        } else {
+            keys[i] = (community * max_nborhood + nborhood_ptr[i]) * max_family + family_ptr[i];
+        }
+    }
+    auto permutation = m_scratch.get<unsigned int>(ScratchArena::sort_permutation, static_cast<std::size_t>(np));
+    std::iota(permutation, permutation + np, 0u);
+    std::stable_sort(permutation, permutation + np,
+                     [keys] (unsigned int a, unsigned int b) { return keys[a] < keys[b]; });
+    ReorderParticles(lev, mfi, permutation);
+#endif
+}
+
+/*! \brief Build the list of infectious agents of each tile
+
+    The indices of the agents that are infectious with at least one disease are compacted into a
+    per-tile list (see AgentContainer::getInfectiousIndices()), so that the interaction models
+    count infectious agents in a time proportional to their number rather than to the number of
+    agents. The number of infectious agents of each disease in each tile is stored as well (see
+    AgentContainer::getNumInfectious()), so that the models can skip tiles free of a disease. The
+    lists are rebuilt only if the disease status of the agents has changed, or if agents have been
+    redistributed, since the last time this function was called.
+
+    The lists are rebuilt rather than updated as the disease status changes: every phase of the day
+    that uses them follows a redistribution (see redistributeAgents()), which moves the agents without
+    telling where, so a maintained list would be discarded anyway. A rebuild is a single pass over the
+    status of the agents, which costs a few percent of the data movement of the redistribution (see
+    utilities/benchmarks/infectious_list_bench.cpp).
+*/
+void AgentContainer::updateInfectiousIndices ()
+{
+    if (m_infectious_indices_valid) { return; }
+
+    BL_PROFILE("AgentContainer::updateInfectiousIndices");
+
+    int nlevs = finestLevel() + 1;
+    m_infectious_index.resize(nlevs);
+    m_num_infectious.resize(nlevs);
+    const int n_disease = m_num_diseases;
+
+    for (int lev = 0; lev < nlevs; ++lev)
+    {
+        // create the entries for all the tiles first, so that the map is not modified in the parallel region
+        for (MFIter mfi = MakeMFIter(lev); mfi.isValid(); ++mfi) {
+            m_infectious_index[lev][std::make_pair(mfi.index(), mfi.LocalTileIndex())];
+            m_num_infectious[lev][std::make_pair(mfi.index(), mfi.LocalTileIndex())];
+        }
+
+#ifdef AMREX_USE_OMP
+#pragma omp parallel if (Gpu::notInLaunchRegion())
+#endif
+        for (MFIter mfi = MakeMFIter(lev); mfi.isValid(); ++mfi) {
+            auto& ptile = ParticlesAt(lev, mfi);
+            const auto& ptd = ptile.getParticleTileData();
+            const auto np = ptile.GetArrayOfStructs().numParticles();
+            auto& infectious_d = m_infectious_index[lev].at(std::make_pair(mfi.index(), mfi.LocalTileIndex()));
+            if (np == 0) {
+                infectious_d.clear();
+                m_num_infectious[lev].at(std::make_pair(mfi.index(), mfi.LocalTileIndex())).fill(0);
+                continue;
+            }
+
+            auto is_infectious = [=] AMREX_GPU_DEVICE (int i) noexcept -> bool {
+                for (int d = 0; d < n_disease; d++) {
+                    if (isInfectious(i, ptd, d)) { return true; }
+                }
+                return false;
+            };
+
+            infectious_d.resize(np);
+            auto infectious_ptr = infectious_d.data();
+            int num_infectious = Scan::PrefixSum<int>(static_cast<int>(np),
+                [=] AMREX_GPU_DEVICE (int i) -> int { return is_infectious(i); },
+                [=] AMREX_GPU_DEVICE (int i, int const& x) { if (is_infectious(i)) { infectious_ptr[x] = i; } },
+                Scan::Type::exclusive, Scan::retSum);
+            infectious_d.resize(num_infectious);
+
+            // count the infectious agents of each disease, so that models can skip diseases absent from the tile
+            auto& num_infectious_disease = m_num_infectious[lev].at(std::make_pair(mfi.index(), mfi.LocalTileIndex()));
+            num_infectious_disease.fill(0);
+            for (int d = 0; d < n_disease; d++) {
+                num_infectious_disease[d] = Reduce::Sum<int>(num_infectious,
+                    [=] AMREX_GPU_DEVICE (int k) -> int { return isInfectious(infectious_ptr[k], ptd, d); });
+            }
+        }
+    }
+
+    m_infectious_indices_valid = true;
+}
+
 /*! \brief Interaction and movement of agents during morning commute
  *
+ * + Simulate interactions during morning commute, if agent.transit_interactions is set (see InteractionModTransit);
+ *   the agents are redistributed first, since some of them may have moved since the last redistribution
  * + Move agents to work
- * + Simulate interactions during morning commute (public transit/carpool/etc ?)
 */
-void AgentContainer::morningCommute ( MultiFab& /*a_mask_behavior*/ /*!< Masking behavior */ )
+void AgentContainer::morningCommute ( MultiFab& a_mask_behavior /*!< Masking behavior */ )
 {
     BL_PROFILE("AgentContainer::morningCommute");
-    //if (haveInteractionModel(ExaEpi::InteractionNames::transit)) {
-    //    m_interactions[ExaEpi::InteractionNames::transit]->interactAgents( *this, a_mask_behavior );
-    //}
+    // the behavior can change from one day to the next
+    m_comm_scale_valid = false;
+    if (haveInteractionModel(ExaEpi::InteractionNames::transit)) {
+        // random and air travelers and hospitalized agents have moved since the last redistribution
+        // (see moveRandomTravel(), moveAirTravel() and updateStatus()), so they may not be in the tile
+        // of their position yet, which the community of the transit groups is looked up from
+        redistributeAgents();
+        updateGroupIndices();
+        updateInfectiousIndices();
+        updateCommunityScale(a_mask_behavior);
+        interactAgents(ExaEpi::InteractionNames::transit, a_mask_behavior);
+    }
     moveAgentsToWork();
 }
 
 /*! \brief Interaction and movement of agents during evening commute
  *
- * + Simulate interactions during evening commute (public transit/carpool/etc ?)
+ * + Simulate interactions during evening commute, if agent.transit_interactions is set (see InteractionModTransit)
  * + Simulate interactions at locations agents may stop by on their way home
  * + Move agents to home
 */
-void AgentContainer::eveningCommute ( MultiFab& /*a_mask_behavior*/ /*!< Masking behavior */ )
+void AgentContainer::eveningCommute ( MultiFab& a_mask_behavior /*!< Masking behavior */ )
 {
     BL_PROFILE("AgentContainer::eveningCommute");
-    //if (haveInteractionModel(ExaEpi::InteractionNames::transit)) {
-    //    m_interactions[ExaEpi::InteractionNames::transit]->interactAgents( *this, a_mask_behavior );
-    //}
+    if (haveInteractionModel(ExaEpi::InteractionNames::transit)) {
+        updateGroupIndices();
+        updateInfectiousIndices();
+        updateCommunityScale(a_mask_behavior);
+        interactAgents(ExaEpi::InteractionNames::transit, a_mask_behavior);
+    }
     //if (haveInteractionModel(ExaEpi::InteractionNames::grocery_store)) {
     //    m_interactions[ExaEpi::InteractionNames::grocery_store]->interactAgents( *this, a_mask_behavior );
     //}
     moveAgentsToHome();
 }
 
+/*! \brief Runs an interaction model, if it is available
+
+    If agent.benchmark_interactions is set, the model is run with two interaction engines
+    (#ExaEpi::InteractionEngine), its own and the one selected by agent.benchmark_engine: the other
+    engine runs first on a copy of the infection probabilities (and of the sampled infectors, see
+    attributeInfections()), then the configured one runs on the originals. The run times of both
+    engines and the largest difference between their results are printed; only the result of the
+    configured engine is kept. */
+void AgentContainer::interactAgents (ExaEpi::InteractionNames a_mod_name, /*!< Interaction model */
+                                     MultiFab& a_mask_behavior /*!< Masking behavior */)
+{
+    if (!haveInteractionModel(a_mod_name)) { return; }
+    auto* model = m_interactions[a_mod_name];
+
+    if (!m_benchmark_interactions) {
+        model->interactAgents(*this, a_mask_behavior);
+        return;
+    }
+
+    BL_PROFILE("AgentContainer::benchmarkInteractions");
+    const int engine = model->engine();
+    const int other_engine = m_benchmark_engines.at(a_mod_name);
+    const int r_RT = RealIdx::nattribs;
+    const int n_disease = m_num_diseases;
+    const int i_RT = IntIdx::nattribs;
+    const int attrib_comps[] = {IntIdxDisease::infection_setting, IntIdxDisease::infector_id, IntIdxDisease::infector_cpu};
+    const int n_attrib = m_attribute_infections ? 3 : 0;
+
+    // copies the infection probabilities of all diseases, and their sampled infectors if infections
+    // are attributed, to (a_to_buf = true) or from a buffer
+    struct ProbBuffer {
+        Gpu::DeviceVector<ParticleReal> prob;
+        Gpu::DeviceVector<int> infector;
+    };
+    using ProbBuffers = amrex::Vector<std::map<std::pair<int,int>, ProbBuffer>>;
+    auto copyProb = [&] (ProbBuffers& a_buf, bool a_to_buf)
+    {
+        a_buf.resize(finestLevel()+1);
+        for (int lev = 0; lev <= finestLevel(); ++lev) {
+            auto& plev = GetParticles(lev);
+            for (MFIter mfi = MakeMFIter(lev); mfi.isValid(); ++mfi) {
+                auto& ptile = plev[std::make_pair(mfi.index(), mfi.LocalTileIndex())];
+                auto& soa = ptile.GetStructOfArrays();
+                const int np = ptile.numParticles();
+                auto& buf = a_buf[lev][std::make_pair(mfi.index(), mfi.LocalTileIndex())];
+                if (a_to_buf) {
+                    buf.prob.resize(std::size_t(np)*n_disease);
+                    buf.infector.resize(std::size_t(np)*n_disease*n_attrib);
+                }
+                for (int d = 0; d < n_disease; d++) {
+                    auto prob_ptr = soa.GetRealData(r_RT+r0(d)+RealIdxDisease::prob).data();
+                    auto buf_ptr = buf.prob.data() + std::size_t(d)*np;
+                    if (a_to_buf) {
+                        amrex::ParallelFor(np, [=] AMREX_GPU_DEVICE (int i) noexcept { buf_ptr[i] = prob_ptr[i]; });
+                    } else {
+                        amrex::ParallelFor(np, [=] AMREX_GPU_DEVICE (int i) noexcept { prob_ptr[i] = buf_ptr[i]; });
+                    }
+                    for (int c = 0; c < n_attrib; c++) {
+                        auto comp_ptr = soa.GetIntData(i_RT+i0(d)+attrib_comps[c]).data();
+                        auto ibuf_ptr = buf.infector.data() + (std::size_t(d)*n_attrib + c)*np;
+                        if (a_to_buf) {
+                            amrex::ParallelFor(np, [=] AMREX_GPU_DEVICE (int i) noexcept { ibuf_ptr[i] = comp_ptr[i]; });
+                        } else {
+                            amrex::ParallelFor(np, [=] AMREX_GPU_DEVICE (int i) noexcept { comp_ptr[i] = ibuf_ptr[i]; });
+                        }
+                    }
+                }
+            }
+        }
+        Gpu::synchronize();
+    };
+
+    auto timedRun = [&] (int a_engine)
+    {
+        model->setEngine(a_engine);
+        Gpu::synchronize();
+        double t0 = amrex::second();
+        model->interactAgents(*this, a_mask_behavior);
+        Gpu::synchronize();
+        auto t = static_cast<Real>(amrex::second() - t0);
+        ParallelDescriptor::ReduceRealMax(t);
+        return t;
+    };
+
+    ProbBuffers prob_init, prob_other;
+    copyProb(prob_init, true);
+    Real other_time = timedRun(other_engine);
+    copyProb(prob_other, true);
+    copyProb(prob_init, false);
+    Real time = timedRun(engine);
+
+    Real max_diff = 0.0_rt;
+    for (int lev = 0; lev <= finestLevel(); ++lev) {
+        auto& plev = GetParticles(lev);
+        for (MFIter mfi = MakeMFIter(lev); mfi.isValid(); ++mfi) {
+            auto& ptile = plev[std::make_pair(mfi.index(), mfi.LocalTileIndex())];
+            auto& soa = ptile.GetStructOfArrays();
+            const int np = ptile.numParticles();
+            const auto& buf = prob_other[lev][std::make_pair(mfi.index(), mfi.LocalTileIndex())];
+            for (int d = 0; d < n_disease; d++) {
+                auto prob_ptr = soa.GetRealData(r_RT+r0(d)+RealIdxDisease::prob).data();
+                auto buf_ptr = buf.prob.data() + std::size_t(d)*np;
+                Real diff = Reduce::Max<Real>(np, [=] AMREX_GPU_DEVICE (int i) noexcept -> Real
+                {
+                    return static_cast<Real>(std::abs(prob_ptr[i] - buf_ptr[i]));
+                });
+                max_diff = amrex::max(max_diff, diff);
+            }
+        }
+    }
+    ParallelDescriptor::ReduceRealMax(max_diff);
+
+    amrex::Print() << "Interaction model " << interactionName(a_mod_name) << ": "
+                   << ExaEpi::interactionEngineName(engine) << " engine " << time << " s, "
+                   << ExaEpi::interactionEngineName(other_engine) << " engine " << other_time << " s, "
+                   << "max. difference in probabilities " << max_diff << "\n";
+}
+
+/*! \brief Can interaction models be computed together by the count engine?
+
+    True if agent.fuse_interactions is set, all models are available and use the count engine,
+    and the interactions are not benchmarked. */
+bool AgentContainer::fuseInteractions (const std::vector<ExaEpi::InteractionNames>& a_mod_names /*!< Interaction models */)
+{
+    if (!m_fuse_interactions || m_benchmark_interactions) { return false; }
+    for (auto mod_name : a_mod_names) {
+        if (!haveInteractionModel(mod_name) ||
+            m_interactions[mod_name]->engine() != ExaEpi::InteractionEngine::count) {
+            return false;
+        }
+    }
+    return true;
+}
+
 /*! \brief Interaction of agents during day time - work and school */
 void AgentContainer::interactDay (MultiFab& a_mask_behavior /*!< Masking behavior */)
 {
     BL_PROFILE("AgentContainer::interactDay");
-    if (haveInteractionModel(ExaEpi::InteractionNames::work)) {
-        m_interactions[ExaEpi::InteractionNames::work]->interactAgents(*this, a_mask_behavior);
-    }
-    if (haveInteractionModel(ExaEpi::InteractionNames::school)) {
-        m_interactions[ExaEpi::InteractionNames::school]->interactAgents(*this, a_mask_behavior);
-    }
-    if (haveInteractionModel(ExaEpi::InteractionNames::work_nborhood)) {
-        m_interactions[ExaEpi::InteractionNames::work_nborhood]->interactAgents(*this, a_mask_behavior);
+    updateGroupIndices();
+    updateInfectiousIndices();
+    updateCommunityScale(a_mask_behavior);
+    if (fuseInteractions({ExaEpi::InteractionNames::work, ExaEpi::InteractionNames::school,
+                          ExaEpi::InteractionNames::work_nborhood})) {
+        // one counting and one update pass for the workgroup, school, work neighborhood and community
+        interactGroupsImpl<PCType, PTDType>(*this,
+            FusedGroupInteraction<PTDType, WorkGroupInteraction<PTDType>,
+                FusedGroupInteraction<PTDType, SchoolGroupInteraction<PTDType>,
+                                      NborhoodGroupInteraction<PTDType, WorkNborhoodCandidate<PTDType>>>>{},
+            m_interactions[ExaEpi::InteractionNames::work]->scratch());
+    } else {
+        interactAgents(ExaEpi::InteractionNames::work, a_mask_behavior);
+        interactAgents(ExaEpi::InteractionNames::school, a_mask_behavior);
+        interactAgents(ExaEpi::InteractionNames::work_nborhood, a_mask_behavior);
     }
     m_hospital->interactAgents(*this, a_mask_behavior);
 }
 
-/*! \brief Interaction of agents during evening (after work) - social stuff */
-void AgentContainer::interactEvening (MultiFab& /*a_mask_behavior*/ /*!< Masking behavior */)
+/*! \brief Interaction of agents during evening (after work) - social stuff
+
+    Agents visit the venues of their community, if agent.venue_prob is set (see InteractionModVenue).
+*/
+void AgentContainer::interactEvening (MultiFab& a_mask_behavior /*!< Masking behavior */)
 {
     BL_PROFILE("AgentContainer::interactEvening");
+    if (haveInteractionModel(ExaEpi::InteractionNames::venue)) {
+        updateGroupIndices();
+        updateInfectiousIndices();
+        updateCommunityScale(a_mask_behavior);
+        interactAgents(ExaEpi::InteractionNames::venue, a_mask_behavior);
+    }
+    ++m_evening_index;
 }
 
 /*! \brief Interaction of agents during nighttime time - at home */
 void AgentContainer::interactNight (MultiFab& a_mask_behavior /*!< Masking behavior */)
 {
     BL_PROFILE("AgentContainer::interactNight");
-    if (haveInteractionModel(ExaEpi::InteractionNames::home)) {
-        m_interactions[ExaEpi::InteractionNames::home]->interactAgents(*this, a_mask_behavior);
+    updateGroupIndices();
+    updateInfectiousIndices();
+    updateCommunityScale(a_mask_behavior);
+    if (fuseInteractions({ExaEpi::InteractionNames::home, ExaEpi::InteractionNames::home_nborhood})) {
+        // one counting and one update pass for the family, neighborhood cluster, neighborhood and community
+        interactGroupsImpl<PCType, PTDType>(*this, FusedGroupInteraction<PTDType, HomeGroupInteraction<PTDType>,
+                                                       NborhoodGroupInteraction<PTDType, HomeNborhoodCandidate<PTDType>>>{},
+                                            m_interactions[ExaEpi::InteractionNames::home]->scratch());
+    } else {
+        interactAgents(ExaEpi::InteractionNames::home, a_mask_behavior);
+        interactAgents(ExaEpi::InteractionNames::home_nborhood, a_mask_behavior);
+    }
+    // air travelers and the residents of their destination (no agents travel on most days)
+    if (m_on_air_travel && haveInteractionModel(ExaEpi::InteractionNames::airTravel)) {
+        interactAgents(ExaEpi::InteractionNames::airTravel, a_mask_behavior);
     }
-    if (haveInteractionModel(ExaEpi::InteractionNames::home_nborhood)) {
-        m_interactions[ExaEpi::InteractionNames::home_nborhood]->interactAgents(*this, a_mask_behavior);
+}
+
+/*! \brief Prints the high-water mark of the scratch memory of each interaction model and of the
+    per-tile passes of the agent container (see #ScratchArena), i.e., the largest amount of scratch
+    memory any process needed */
+void AgentContainer::printInteractionScratchUsage () const
+{
+    Long total = 0;
+    for (const auto& model : m_interactions) {
+        Long bytes = model.second->scratch().highWaterMark();
+        ParallelDescriptor::ReduceLongMax(bytes);
+        total += bytes;
+        amrex::Print() << "Interaction scratch memory, " << ExaEpi::interactionName(model.first) << ": "
+                       << bytes << " bytes\n";
     }
+    Long bytes = m_scratch.highWaterMark();
+    ParallelDescriptor::ReduceLongMax(bytes);
+    total += bytes;
+    amrex::Print() << "Interaction scratch memory, group indices and infections: " << bytes << " bytes\n";
+    amrex::Print() << "Interaction scratch memory, total: " << total << " bytes\n";
 }
 
 void AgentContainer::printStudentTeacherCounts() const {
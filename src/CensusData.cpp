@@ -322,6 +322,10 @@ void CensusData::initAgents (AgentContainer& pc,       /*!< Agents */
             status_ptrs[d] = soa.GetIntData(i_RT+i0(d)+IntIdxDisease::status).data();
             counter_ptrs[d] = soa.GetRealData(r_RT+r0(d)+RealIdxDisease::disease_counter).data();
             timer_ptrs[d] = soa.GetRealData(r_RT+r0(d)+RealIdxDisease::treatment_timer).data();
+            // no infector has been sampled yet
+            soa.GetIntData(i_RT+i0(d)+IntIdxDisease::infection_setting).assign(-1);
+            soa.GetIntData(i_RT+i0(d)+IntIdxDisease::infector_id).assign(-1);
+            soa.GetIntData(i_RT+i0(d)+IntIdxDisease::infector_cpu).assign(-1);
         }
 
         auto dx = pc.ParticleGeom(0).CellSizeArray();
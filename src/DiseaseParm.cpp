@@ -4,6 +4,8 @@
 
 #include "DiseaseParm.H"
 
+#include <limits>
+
 #include "AMReX_Print.H"
 
 using namespace amrex;
@@ -58,6 +60,8 @@ void DiseaseParm::readInputs ( const std::string& a_pp_str /*!< Parmparse string
     queryArray(pp, "xmit_hh_child", xmit_hh_child, AgeGroups::total);
     queryArray(pp, "xmit_nc_adult", xmit_nc_adult, AgeGroups::total);
     queryArray(pp, "xmit_nc_child", xmit_nc_child, AgeGroups::total);
+    queryArray(pp, "xmit_transit", xmit_transit, AgeGroups::total);
+    queryArray(pp, "xmit_venue", xmit_venue, AgeGroups::total);
 
     queryArray(pp, "xmit_school", xmit_school, SchoolType::total);
     queryArray(pp, "xmit_school_a2c", xmit_school_a2c, SchoolType::total);
@@ -125,6 +129,8 @@ void DiseaseParm::Initialize ()
         xmit_nc_child[i] *= p_trans;
         xmit_hh_adult[i] *= p_trans;
         xmit_hh_child[i] *= p_trans;
+        xmit_transit[i] *= p_trans;
+        xmit_venue[i] *= p_trans;
     }
 
     for (int i = 0; i < 5; i++) {
@@ -157,5 +163,86 @@ void DiseaseParm::Initialize ()
         xmit_hood_SC[i] = xmit_hood[i];
     }
 
+    computeLogXmit();
+}
+
+/*! \brief Compute the log-probabilities of not being infected by one infectious agent (see
+    DiseaseParm::log_xmit_work etc.), for hazard accumulation, from the transmission probabilities
+
+    They are kept finite (for a transmission probability of 1), so that multiplying them by a zero
+    count gives zero.
+*/
+void DiseaseParm::computeLogXmit ()
+{
+    const Real infect = 1.0_rt - vac_eff;
+    auto log_no_xmit = [infect] (Real xmit) {
+        return amrex::max(std::log1p(-infect * xmit), std::numeric_limits<Real>::lowest());
+    };
+    for (int i = 0; i < AgeGroups::total; i++) {
+        log_xmit_comm[i] = log_no_xmit(xmit_comm[i]);
+        log_xmit_hood[i] = log_no_xmit(xmit_hood[i]);
+        log_xmit_hh_adult[i] = log_no_xmit(xmit_hh_adult[i]);
+        log_xmit_hh_child[i] = log_no_xmit(xmit_hh_child[i]);
+        log_xmit_nc_adult[i] = log_no_xmit(xmit_nc_adult[i]);
+        log_xmit_nc_child[i] = log_no_xmit(xmit_nc_child[i]);
+        log_xmit_transit[i] = log_no_xmit(xmit_transit[i]);
+        log_xmit_venue[i] = log_no_xmit(xmit_venue[i]);
+    }
+    for (int i = 0; i < SchoolType::total; i++) {
+        log_xmit_school[i] = log_no_xmit(xmit_school[i]);
+        log_xmit_school_a2c[i] = log_no_xmit(xmit_school_a2c[i]);
+        log_xmit_school_c2a[i] = log_no_xmit(xmit_school_c2a[i]);
+    }
+    log_xmit_work = log_no_xmit(xmit_work);
 }
 
+/*! \brief Return the transmission probability of a contact scaled by the community, given its
+    flat index (#ScaledXmit) */
+Real DiseaseParm::scaledXmit (int a_idx /*!< flat index (#ScaledXmit) */) const
+{
+    AMREX_ASSERT(a_idx >= 0 && a_idx < ScaledXmit::total);
+    if (a_idx >= ScaledXmit::work) { return xmit_work; }
+    if (a_idx >= ScaledXmit::school_c2a) { return xmit_school_c2a[a_idx - ScaledXmit::school_c2a]; }
+    if (a_idx >= ScaledXmit::school_a2c) { return xmit_school_a2c[a_idx - ScaledXmit::school_a2c]; }
+    if (a_idx >= ScaledXmit::school) { return xmit_school[a_idx - ScaledXmit::school]; }
+    if (a_idx >= ScaledXmit::venue) { return xmit_venue[a_idx - ScaledXmit::venue]; }
+    if (a_idx >= ScaledXmit::transit) { return xmit_transit[a_idx - ScaledXmit::transit]; }
+    if (a_idx >= ScaledXmit::nc_child) { return xmit_nc_child[a_idx - ScaledXmit::nc_child]; }
+    if (a_idx >= ScaledXmit::nc_adult) { return xmit_nc_adult[a_idx - ScaledXmit::nc_adult]; }
+    if (a_idx >= ScaledXmit::hood) { return xmit_hood[a_idx - ScaledXmit::hood]; }
+    return xmit_comm[a_idx - ScaledXmit::comm];
+}
+
+/*! \brief Scale all the transmission probabilities by a factor
+
+    Used to derive the parameters seen by the agents exposed to asymptomatic infectious agents,
+    whose infectiousness is scaled by #DiseaseParm::asymp_relative_inf (see
+    AgentContainer::getAsympDiseaseParameters_d()). Must be called after DiseaseParm::Initialize().
+*/
+void DiseaseParm::scaleTransmission (Real a_factor /*!< scaling factor, from 0 to 1 */)
+{
+    AMREX_ALWAYS_ASSERT(a_factor >= 0.0_rt && a_factor <= 1.0_rt);
+    xmit_work *= a_factor;
+    for (int i = 0; i < AgeGroups::total; i++) {
+        xmit_comm[i] *= a_factor;
+        xmit_hood[i] *= a_factor;
+        xmit_hh_adult[i] *= a_factor;
+        xmit_hh_child[i] *= a_factor;
+        xmit_nc_adult[i] *= a_factor;
+        xmit_nc_child[i] *= a_factor;
+        xmit_transit[i] *= a_factor;
+        xmit_venue[i] *= a_factor;
+        xmit_comm_SC[i] *= a_factor;
+        xmit_hood_SC[i] *= a_factor;
+        xmit_hh_adult_SC[i] *= a_factor;
+        xmit_hh_child_SC[i] *= a_factor;
+        xmit_nc_adult_SC[i] *= a_factor;
+        xmit_nc_child_SC[i] *= a_factor;
+    }
+    for (int i = 0; i < SchoolType::total; i++) {
+        xmit_school[i] *= a_factor;
+        xmit_school_a2c[i] *= a_factor;
+        xmit_school_c2a[i] *= a_factor;
+    }
+    computeLogXmit();
+}
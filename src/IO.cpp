@@ -137,6 +137,9 @@ void writePlotFile (const AgentContainer& pc, /*!< Agent (particle) container */
             real_varnames.push_back("incubation_period"); write_real_comp.push_back(static_cast<int>(step==0));
             int_varnames.push_back ("status"); write_int_comp.push_back(1);
             int_varnames.push_back ("symptomatic"); write_int_comp.push_back(1);
+            int_varnames.push_back ("infection_setting"); write_int_comp.push_back(0);
+            int_varnames.push_back ("infector_id"); write_int_comp.push_back(0);
+            int_varnames.push_back ("infector_cpu"); write_int_comp.push_back(0);
         } else {
             for (int d = 0; d < num_diseases; d++) {
                 real_varnames.push_back(disease_names[d]+"treatment_timer"); write_real_comp.push_back(1);
@@ -147,9 +150,21 @@ void writePlotFile (const AgentContainer& pc, /*!< Agent (particle) container */
                 real_varnames.push_back(disease_names[d]+"_incubation_period"); write_real_comp.push_back(static_cast<int>(step==0));
                 int_varnames.push_back (disease_names[d]+"_status"); write_int_comp.push_back(1);
                 int_varnames.push_back (disease_names[d]+"_symptomatic"); write_int_comp.push_back(1);
+                int_varnames.push_back (disease_names[d]+"_infection_setting"); write_int_comp.push_back(0);
+                int_varnames.push_back (disease_names[d]+"_infector_id"); write_int_comp.push_back(0);
+                int_varnames.push_back (disease_names[d]+"_infector_cpu"); write_int_comp.push_back(0);
             }
         }
 
+        // interaction group indices (tile-local, so not written)
+        int_varnames.push_back ("group_community"); write_int_comp.push_back(0);
+        int_varnames.push_back ("group_family"); write_int_comp.push_back(0);
+        int_varnames.push_back ("group_nc"); write_int_comp.push_back(0);
+        int_varnames.push_back ("group_nborhood"); write_int_comp.push_back(0);
+        int_varnames.push_back ("group_workgroup"); write_int_comp.push_back(0);
+        int_varnames.push_back ("group_school"); write_int_comp.push_back(0);
+        int_varnames.push_back ("group_transit"); write_int_comp.push_back(0);
+
 #ifdef AMREX_USE_HDF5
         pc.WritePlotFileHDF5(   amrex::Concatenate("plt", step, 5),
                                 "agents",
@@ -259,5 +274,42 @@ void writeFIPSData (const AgentContainer& agents, /*!< Agents (particle) contain
     }
 }
 
+/*! \brief Writes the infections recorded since the last call (see AgentContainer::infectAgents())
+
+    Each process appends its infection events (see #InfectionEvent) to its own file, named
+    prefix followed by the process number, which is truncated at step 0 so that the events of an
+    earlier run in the same directory are not kept. There is one line per infection:
+    step, agent ID, agent CPU, disease name, setting (see ExaEpi::infectionSettingName()), infector ID and
+    infector CPU (-1 if the infection could not be attributed). The events of the tiles are written in
+    tile order. The infector and the infected agent together identify an edge of the transmission tree.
+*/
+void writeInfectionEvents (const AgentContainer& agents, /*!< Agents (particle) container */
+                           const std::string& prefix, /*!< Filename prefix */
+                           const std::vector<std::string>& disease_names, /*!< Names of diseases */
+                           const int step /*!< Current step */)
+{
+    BL_PROFILE("ExaEpi::IO::writeInfectionEvents");
+
+    std::string fn = amrex::Concatenate(prefix, ParallelDescriptor::MyProc(), 5);
+    std::ofstream ofs{fn, std::ofstream::out | (step == 0 ? std::ofstream::trunc : std::ofstream::app)};
+    if (!ofs.good()) {
+        amrex::FileOpenFailed(fn);
+    }
+
+    for (const auto& lev_events : agents.getInfectionEvents()) {
+        for (const auto& tile_events : lev_events) {
+            const auto& events_d = tile_events.second;
+            std::vector<InfectionEvent> events(events_d.size());
+            amrex::Gpu::copy(amrex::Gpu::deviceToHost, events_d.begin(), events_d.end(), events.begin());
+            for (const auto& e : events) {
+                ofs << step << " " << e.id << " " << e.cpu << " " << disease_names[e.disease] << " "
+                    << infectionSettingName(e.setting) << " "
+                    << e.infector_id << " " << e.infector_cpu << "\n";
+            }
+        }
+    }
+    ofs.close();
+}
+
 }
 }
@@ -69,6 +69,7 @@ void ExaEpi::Utils::get_test_params (   TestParams& params,         /*!< Test pa
         params.aggregated_diag_prefix = "cases";
         pp.get("aggregated_diag_prefix", params.aggregated_diag_prefix);
     }
+    pp.query("infection_events_prefix", params.infection_events_prefix);
 
     pp.query("shelter_start",  params.shelter_start);
     pp.query("shelter_length", params.shelter_length);
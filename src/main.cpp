@@ -91,6 +91,8 @@ int main (int argc, /*!< Number of command line arguments */
       + Move agents to home - see AgentContainer::moveAgentsToHome().
       + Let agents interact at home - see AgentContainer::interactAgentsHomeWork().
       + Infect agents based on their movements during the day - see AgentContainer::infectAgents().
+      + If infections are attributed (see AgentContainer::attributeInfections()), write out the
+        infections of the day - see ExaEpi::IO::writeInfectionEvents().
     + Get disease statistics counts - see AgentContainer::printTotals() - and update the
       peak number of infections and cumulative deaths.
 
@@ -220,6 +222,8 @@ void runAgent ()
             }
         }
 
+        pc.buildCommunityIndex();
+
         pc.printStudentTeacherCounts();
         pc.printAgeGroupCounts();
 
@@ -424,6 +428,11 @@ void runAgent ()
             // Infect agents based on their interactions
             pc.infectAgents();
 
+            if (pc.attributeInfections()) {
+                ExaEpi::IO::writeInfectionEvents(pc, params.infection_events_prefix, params.disease_names, i);
+                pc.clearInfectionEvents();
+            }
+
             std::chrono::duration<double> elapsed_time = std::chrono::high_resolution_clock::now() - start_time;
 
             Print() << "[Day " << cur_time <<  " " << std::fixed << std::setprecision(1) << elapsed_time.count() << "s] infected: ";
@@ -455,6 +464,8 @@ void runAgent ()
         amrex::Print() << "\n \n";
     }
 
+    pc.printInteractionScratchUsage();
+
     if (params.plot_int > 0) {
         ExaEpi::IO::writePlotFile(pc, censusData, params.num_diseases, params.disease_names, cur_time, params.nsteps);
     }
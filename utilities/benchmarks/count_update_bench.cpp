@@ -0,0 +1,309 @@
+/*! @file count_update_bench.cpp
+    \brief Standalone microbenchmark of the CPU update pass of the count engine
+
+    Mimics the update pass of interactGroupsND() (src/InteractionModel.H) for the nborhood model
+    (community and neighborhood tables, one disease, two infectiousness classes) on a single
+    tile, without AMReX, and times:
+
+    + scalar:           the per-agent loop with early returns, used on GPUs, with attribution,
+                        and on CPUs in the default mode
+    + scalar_hazard:    the same loop in hazard mode (see agent.hazard_accumulation)
+    + block_pow:        the blocked loop before it was restricted to hazard mode: scalar
+                        selection, then a loop under AMREX_PRAGMA_SIMD (GCC ivdep for GCC)
+                        calling std::pow per contact
+    + block_hazard_old: the same blocked loop in hazard mode
+    + block_hazard:     the blocked loop of interactGroupsND() in hazard mode: the susceptible
+                        agents are selected with the exposed ones, and the contacts add the
+                        logarithms of the per-community tables (see AgentContainer::getCommunityLogXmit())
+
+    Build and run (single precision, as the default ExaEpi build):
+
+        g++ -O3 -march=native -o count_update_bench count_update_bench.cpp
+        ./count_update_bench [num_agents] [num_repeats]
+
+    Add -fopt-info-vec-optimized to check which loops are vectorized. The blocked loops need
+    gathers; some GCC versions disable them when tuning for recent Intel CPUs, in which case
+    -mtune=icelake-server (or another target that keeps them) is needed to vectorize them.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <random>
+#include <vector>
+
+using Real = float;
+
+namespace {
+
+constexpr int n_table = 2;    // community and neighborhood
+constexpr int n_count = 2;    // infectiousness classes (one transmitter class, one disease)
+constexpr int n_age = 6;
+constexpr int n_xmit = 2 * n_age;  // scaled transmission probabilities (community and neighborhood)
+constexpr int block_size = 256;
+
+struct Tile
+{
+    int np = 0;
+    std::vector<int> group[n_table];
+    std::vector<int> counts[n_table];
+    std::vector<unsigned int> occupied[n_table];
+    std::vector<int> comm;
+    std::vector<int> age;
+    std::vector<int> status;
+    std::vector<Real> comm_scale;
+    std::vector<Real> comm_log_xmit;  // [comm][class][xmit]
+    Real xmit[n_count][n_xmit];
+    Real log_xmit[n_count][n_xmit];   // unscaled, for the contacts that are not scaled
+};
+
+bool isOccupied (const unsigned int* occupied, int g) { return (occupied[g >> 5] >> (g & 31)) & 1u; }
+
+Tile makeTile (int np, std::mt19937& rng)
+{
+    Tile tile;
+    tile.np = np;
+    const int comm_size = 2000, hood_size = 500;
+    const int num_comms = (np + comm_size - 1) / comm_size;
+    const int num_hoods = (np + hood_size - 1) / hood_size;
+    std::uniform_real_distribution<Real> uniform(0, 1);
+    std::uniform_int_distribution<int> age(0, n_age - 1);
+    tile.comm.resize(np);
+    tile.age.resize(np);
+    tile.status.resize(np);
+    tile.group[0].resize(np);
+    tile.group[1].resize(np);
+    for (int i = 0; i < np; ++i) {
+        // agents sorted by community, as after AgentContainer::sortAgents()
+        tile.comm[i] = i / comm_size;
+        tile.group[0][i] = i / comm_size;
+        tile.group[1][i] = i / hood_size;
+        tile.age[i] = age(rng);
+        tile.status[i] = (uniform(rng) < 0.9f) ? 0 : 1;  // 90% susceptible
+    }
+    const int num_groups[n_table] = {num_comms, num_hoods};
+    for (int t = 0; t < n_table; ++t) {
+        tile.counts[t].assign(num_groups[t] * n_count, 0);
+        tile.occupied[t].assign((num_groups[t] + 31) / 32, 0u);
+    }
+    // 1% of the agents infectious, a quarter of them asymptomatic
+    for (int i = 0; i < np; ++i) {
+        if (uniform(rng) >= 0.01f) { continue; }
+        const int c = (uniform(rng) < 0.25f) ? 1 : 0;
+        for (int t = 0; t < n_table; ++t) {
+            const int g = tile.group[t][i];
+            tile.counts[t][g * n_count + c] += 1;
+            tile.occupied[t][g >> 5] |= 1u << (g & 31);
+        }
+    }
+    for (int k = 0; k < n_xmit; ++k) {
+        const Real x = (k < n_age) ? Real(0.000145) : Real(0.00058);
+        tile.xmit[0][k] = x;
+        tile.xmit[1][k] = x * Real(0.75);
+        for (int c = 0; c < n_count; ++c) { tile.log_xmit[c][k] = std::log1p(-tile.xmit[c][k]); }
+    }
+    tile.comm_scale.resize(num_comms);
+    tile.comm_log_xmit.resize(num_comms * n_count * n_xmit);
+    for (int m = 0; m < num_comms; ++m) {
+        tile.comm_scale[m] = Real(0.5) + uniform(rng);
+        for (int c = 0; c < n_count; ++c) {
+            for (int k = 0; k < n_xmit; ++k) {
+                tile.comm_log_xmit[(m * n_count + c) * n_xmit + k] = std::max(
+                    std::log1p(-std::min(tile.xmit[c][k] * tile.comm_scale[m], Real(1))),
+                    std::numeric_limits<Real>::lowest());
+            }
+        }
+    }
+    return tile;
+}
+
+// contacts of the nborhood model: community minus neighborhood, and neighborhood
+template <typename F>
+inline void contacts (int age, const int* n, F const& contact)
+{
+    contact(n[0] - n[1], age);
+    contact(n[1], n_age + age);
+}
+
+void updateScalar (const Tile& tile, Real* prob_ptr, bool hazard)
+{
+    for (int i = 0; i < tile.np; ++i) {
+        if (tile.status[i] != 0) { continue; }
+        int g[n_table];
+        bool exposed = false;
+        for (int t = 0; t < n_table; ++t) {
+            g[t] = tile.group[t][i];
+            exposed = exposed || isOccupied(tile.occupied[t].data(), g[t]);
+        }
+        if (!exposed) { continue; }
+        const int m = tile.comm[i];
+        const Real comm_scale = tile.comm_scale[m];
+        const Real* log_xmit_comm = tile.comm_log_xmit.data() + m * n_count * n_xmit;
+        Real prob = prob_ptr[i];
+        for (int c = 0; c < n_count; ++c) {
+            int n[n_table];
+            for (int t = 0; t < n_table; ++t) { n[t] = tile.counts[t][g[t] * n_count + c]; }
+            contacts(tile.age[i], n, [&] (int count, int k) {
+                if (count == 0) { return; }
+                if (hazard) {
+                    prob += count * log_xmit_comm[c * n_xmit + k];
+                } else {
+                    prob *= std::pow(Real(1) - tile.xmit[c][k] * comm_scale, count);
+                }
+            });
+        }
+        prob_ptr[i] = prob;
+    }
+}
+
+// selection of the candidates whose groups have infectious agents, as in interactGroupsND()
+int selectBlock (const Tile& tile, int kbegin, int kend, int* selected)
+{
+    int num_selected = 0;
+    for (int i = kbegin; i < kend; ++i) {
+        bool exposed = false;
+        for (int t = 0; t < n_table; ++t) {
+            exposed = exposed || isOccupied(tile.occupied[t].data(), tile.group[t][i]);
+        }
+        selected[num_selected] = i;
+        num_selected += exposed;
+    }
+    return num_selected;
+}
+
+// blocked loop before the fix: both modes, susceptibility applied by a select on the result,
+// and the count index captured by reference by the contact callback
+template <bool hazard>
+void updateBlockOld (const Tile& tile, Real* prob_ptr)
+{
+    const int* comm_ptr = tile.comm.data();
+    const int* age_ptr = tile.age.data();
+    const int* status_ptr = tile.status.data();
+    const Real* comm_scale_ptr = tile.comm_scale.data();
+    const Real* comm_log_xmit_ptr = tile.comm_log_xmit.data();
+    const int* group_ptrs[n_table] = {tile.group[0].data(), tile.group[1].data()};
+    const int* counts[n_table] = {tile.counts[0].data(), tile.counts[1].data()};
+    Real xmit[n_count][n_xmit];
+    std::copy(&tile.xmit[0][0], &tile.xmit[0][0] + n_count * n_xmit, &xmit[0][0]);
+
+    for (int kbegin = 0; kbegin < tile.np; kbegin += block_size) {
+        int selected[block_size];
+        const int num_selected = selectBlock(tile, kbegin, std::min(kbegin + block_size, tile.np), selected);
+        Real* __restrict__ prob_out = prob_ptr;
+#pragma GCC ivdep
+        for (int k = 0; k < num_selected; ++k) {
+            const int i = selected[k];
+            const Real prob_old = prob_out[i];
+            Real prob = prob_old;
+            const int m = comm_ptr[i];
+            const Real comm_scale = comm_scale_ptr[m];
+            const Real* log_xmit_comm = comm_log_xmit_ptr + m * n_count * n_xmit;
+            int c = 0;
+            auto contact = [&] (int count, int x) {
+                if (hazard) {
+                    prob += static_cast<Real>(count) * log_xmit_comm[c * n_xmit + x];
+                } else {
+                    prob *= std::pow(Real(1) - xmit[c][x] * comm_scale, count);
+                }
+            };
+            for (c = 0; c < n_count; ++c) {
+                int n[n_table];
+                for (int t = 0; t < n_table; ++t) { n[t] = counts[t][group_ptrs[t][i] * n_count + c]; }
+                contacts(age_ptr[i], n, contact);
+            }
+            prob_out[i] = (status_ptr[i] == 0) ? prob : prob_old;
+        }
+    }
+}
+
+// blocked loop after the fix: hazard mode only, the susceptible agents are selected with the
+// exposed ones, and the contact callback captures the log-probabilities of the count by value
+void updateBlockHazard (const Tile& tile, Real* prob_ptr)
+{
+    const int* comm_ptr = tile.comm.data();
+    const int* age_ptr = tile.age.data();
+    const int* status_ptr = tile.status.data();
+    const Real* comm_log_xmit_ptr = tile.comm_log_xmit.data();
+    const int* group_ptrs[n_table] = {tile.group[0].data(), tile.group[1].data()};
+    const int* counts[n_table] = {tile.counts[0].data(), tile.counts[1].data()};
+
+    for (int kbegin = 0; kbegin < tile.np; kbegin += block_size) {
+        int selected[block_size];
+        const int num_selected = selectBlock(tile, kbegin, std::min(kbegin + block_size, tile.np), selected);
+        int susceptible[block_size];
+        int num_susceptible = 0;
+        for (int k = 0; k < num_selected; ++k) {
+            susceptible[num_susceptible] = selected[k];
+            num_susceptible += (status_ptr[selected[k]] == 0);
+        }
+        Real* __restrict__ prob_out = prob_ptr;
+#pragma GCC ivdep
+        for (int k = 0; k < num_susceptible; ++k) {
+            const int i = susceptible[k];
+            const Real* log_xmit_comm = comm_log_xmit_ptr + comm_ptr[i] * n_count * n_xmit;
+            Real log_prob = 0;
+            for (int c = 0; c < n_count; ++c) {
+                int n[n_table];
+                for (int t = 0; t < n_table; ++t) { n[t] = counts[t][group_ptrs[t][i] * n_count + c]; }
+                const Real* log_xmit_c = log_xmit_comm + c * n_xmit;
+                contacts(age_ptr[i], n, [&log_prob, log_xmit_c] (int count, int x) {
+                    log_prob += static_cast<Real>(count) * log_xmit_c[x];
+                });
+            }
+            prob_out[i] += log_prob;
+        }
+    }
+}
+
+template <typename F>
+double timeIt (int repeats, std::vector<Real>& prob, Real init, F const& f)
+{
+    double best = std::numeric_limits<double>::max();
+    for (int r = 0; r < repeats; ++r) {
+        std::fill(prob.begin(), prob.end(), init);
+        auto start = std::chrono::steady_clock::now();
+        f();
+        auto stop = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double>(stop - start).count());
+    }
+    return best;
+}
+
+}
+
+int main (int argc, char* argv[])
+{
+    const int np = (argc > 1) ? std::atoi(argv[1]) : 4000000;
+    const int repeats = (argc > 2) ? std::atoi(argv[2]) : 10;
+    std::mt19937 rng(42);
+    const Tile tile = makeTile(np, rng);
+
+    std::vector<Real> prob_scalar(np), prob_scalar_hazard(np), prob_pow(np), prob_old(np), prob_new(np);
+    const double t_scalar = timeIt(repeats, prob_scalar, Real(1), [&] { updateScalar(tile, prob_scalar.data(), false); });
+    const double t_scalar_hazard = timeIt(repeats, prob_scalar_hazard, Real(0), [&] { updateScalar(tile, prob_scalar_hazard.data(), true); });
+    const double t_pow = timeIt(repeats, prob_pow, Real(1), [&] { updateBlockOld<false>(tile, prob_pow.data()); });
+    const double t_old = timeIt(repeats, prob_old, Real(0), [&] { updateBlockOld<true>(tile, prob_old.data()); });
+    const double t_new = timeIt(repeats, prob_new, Real(0), [&] { updateBlockHazard(tile, prob_new.data()); });
+
+    // the blocked loops must give the same probabilities as the scalar ones (up to the order of
+    // the sums), and the two modes the same probabilities up to round-off
+    double diff_pow = 0, diff_old = 0, diff_new = 0, diff_modes = 0;
+    for (int i = 0; i < np; ++i) {
+        diff_pow = std::max(diff_pow, double(std::abs(prob_pow[i] - prob_scalar[i])));
+        diff_old = std::max(diff_old, double(std::abs(prob_old[i] - prob_scalar_hazard[i])));
+        diff_new = std::max(diff_new, double(std::abs(prob_new[i] - prob_scalar_hazard[i])));
+        diff_modes = std::max(diff_modes, double(std::abs(std::exp(prob_scalar_hazard[i]) - prob_scalar[i])));
+    }
+
+    std::printf("%d agents, best of %d runs, ns per agent\n", np, repeats);
+    std::printf("  scalar            %8.2f\n", 1e9 * t_scalar / np);
+    std::printf("  scalar_hazard     %8.2f\n", 1e9 * t_scalar_hazard / np);
+    std::printf("  block_pow         %8.2f (max diff to scalar %g)\n", 1e9 * t_pow / np, diff_pow);
+    std::printf("  block_hazard_old  %8.2f (max diff to scalar_hazard %g)\n", 1e9 * t_old / np, diff_old);
+    std::printf("  block_hazard      %8.2f (max diff to scalar_hazard %g)\n", 1e9 * t_new / np, diff_new);
+    std::printf("  max |exp(scalar_hazard) - scalar| %g\n", diff_modes);
+    return 0;
+}
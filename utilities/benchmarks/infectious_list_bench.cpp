@@ -0,0 +1,174 @@
+/*! @file infectious_list_bench.cpp
+    \brief Standalone microbenchmark of the lists of infectious agents on CPUs
+
+    Mimics AgentContainer::updateInfectiousIndices() (src/AgentContainer.cpp) for one disease on
+    a single tile, without AMReX, and compares it to the data movement of the redistribution that
+    precedes every rebuild in a simulated day:
+
+    + rebuild:     compaction of the infectious agents with a prefix sum, followed by the count of
+                   the infectious agents of the disease, as in updateInfectiousIndices()
+    + incremental: the best case of a list maintained across status updates, i.e., dropping the
+                   agents that are not infectious anymore and appending a given list of agents
+                   that became infectious, without scanning the tile
+    + copy:        a sequential copy of all the components of the agents (one disease, group
+                   components included), a lower bound of the cost of Redistribute()
+    + gather:      the same copy through a random permutation, as ReorderParticles() after
+                   AgentContainer::sortAgents()
+
+    Build and run (single precision, as the default ExaEpi build):
+
+        g++ -O3 -march=native -o infectious_list_bench infectious_list_bench.cpp
+        ./infectious_list_bench [num_agents] [num_repeats] [infectious_fraction]
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <vector>
+
+using Real = float;
+
+namespace {
+
+// IntIdx, IntIdxDisease and IntIdxGroup components, RealIdxDisease components (one disease)
+constexpr int n_int = 20 + 5 + 7;
+constexpr int n_real = 6;
+constexpr int infected = 2;
+
+struct Tile
+{
+    int np = 0;
+    std::vector<int> status;
+    std::vector<Real> counter;
+    std::vector<Real> latent;
+    std::vector<int> became_infectious;  // agents that became infectious during the last update
+    std::vector<std::vector<int>> idata;
+    std::vector<std::vector<Real>> rdata;
+    std::vector<unsigned long long> idcpu;
+    std::vector<Real> pos;
+};
+
+bool isInfectious (const Tile& tile, int i)
+{
+    return tile.status[i] == infected && tile.counter[i] >= tile.latent[i];
+}
+
+Tile makeTile (int np, double fraction, std::mt19937& rng)
+{
+    Tile tile;
+    tile.np = np;
+    std::uniform_real_distribution<double> uniform(0, 1);
+    tile.status.resize(np);
+    tile.counter.resize(np);
+    tile.latent.assign(np, Real(3));
+    for (int i = 0; i < np; ++i) {
+        // the infected agents are infectious for the most part, some are still latent
+        const bool inf = uniform(rng) < 1.25 * fraction;
+        tile.status[i] = inf ? infected : 0;
+        tile.counter[i] = inf ? Real(10 * uniform(rng)) : Real(0);
+        // about a tenth of the infectious agents became infectious during the last update
+        if (isInfectious(tile, i) && uniform(rng) < 0.1) { tile.became_infectious.push_back(i); }
+    }
+    tile.idata.assign(n_int, std::vector<int>(np, 1));
+    tile.rdata.assign(n_real, std::vector<Real>(np, Real(1)));
+    tile.idcpu.assign(np, 1);
+    tile.pos.assign(2 * static_cast<std::size_t>(np), Real(1));
+    return tile;
+}
+
+// serial exclusive prefix sum, as amrex::Scan::PrefixSum on CPUs
+int rebuild (const Tile& tile, std::vector<int>& list)
+{
+    list.resize(tile.np);
+    int x = 0;
+    for (int i = 0; i < tile.np; ++i) {
+        if (isInfectious(tile, i)) { list[x++] = i; }
+    }
+    list.resize(x);
+    int num_infectious = 0;
+    for (int k = 0; k < x; ++k) { num_infectious += isInfectious(tile, list[k]); }
+    return num_infectious;
+}
+
+int incremental (const Tile& tile, std::vector<int>& list)
+{
+    auto end = std::remove_if(list.begin(), list.end(), [&] (int i) { return !isInfectious(tile, i); });
+    list.erase(end, list.end());
+    list.insert(list.end(), tile.became_infectious.begin(), tile.became_infectious.end());
+    return static_cast<int>(list.size());
+}
+
+void copy (const Tile& tile, Tile& out, const int* permutation)
+{
+    const int np = tile.np;
+    for (int n = 0; n < n_int; ++n) {
+        const int* src = tile.idata[n].data();
+        int* dst = out.idata[n].data();
+        if (permutation) { for (int i = 0; i < np; ++i) { dst[i] = src[permutation[i]]; } }
+        else { for (int i = 0; i < np; ++i) { dst[i] = src[i]; } }
+    }
+    for (int n = 0; n < n_real; ++n) {
+        const Real* src = tile.rdata[n].data();
+        Real* dst = out.rdata[n].data();
+        if (permutation) { for (int i = 0; i < np; ++i) { dst[i] = src[permutation[i]]; } }
+        else { for (int i = 0; i < np; ++i) { dst[i] = src[i]; } }
+    }
+    for (int i = 0; i < np; ++i) {
+        const int j = permutation ? permutation[i] : i;
+        out.idcpu[i] = tile.idcpu[j];
+        out.pos[2*i] = tile.pos[2*j];
+        out.pos[2*i+1] = tile.pos[2*j+1];
+    }
+}
+
+template <typename F>
+double timeIt (int repeats, F const& f)
+{
+    double best = std::numeric_limits<double>::max();
+    for (int r = 0; r < repeats; ++r) {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        auto stop = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double>(stop - start).count());
+    }
+    return best;
+}
+
+}
+
+int main (int argc, char* argv[])
+{
+    const int np = (argc > 1) ? std::atoi(argv[1]) : 4000000;
+    const int repeats = (argc > 2) ? std::atoi(argv[2]) : 10;
+    const double fraction = (argc > 3) ? std::atof(argv[3]) : 0.01;
+    std::mt19937 rng(42);
+    const Tile tile = makeTile(np, fraction, rng);
+    Tile out = makeTile(np, fraction, rng);
+    std::vector<int> permutation(np);
+    std::iota(permutation.begin(), permutation.end(), 0);
+    std::shuffle(permutation.begin(), permutation.end(), rng);
+
+    std::vector<int> list;
+    int num_infectious = 0;
+    const double t_rebuild = timeIt(repeats, [&] { num_infectious = rebuild(tile, list); });
+    // the maintained list holds the agents that were infectious before the update
+    std::vector<int> previous;
+    std::set_difference(list.begin(), list.end(), tile.became_infectious.begin(), tile.became_infectious.end(),
+                        std::back_inserter(previous));
+    std::vector<int> maintained;
+    const double t_incremental = timeIt(repeats, [&] { maintained = previous; incremental(tile, maintained); });
+    const double t_copy = timeIt(repeats, [&] { copy(tile, out, nullptr); });
+    const double t_gather = timeIt(repeats, [&] { copy(tile, out, permutation.data()); });
+
+    std::printf("%d agents, %d infectious, best of %d runs, ns per agent\n", np, num_infectious, repeats);
+    std::printf("  rebuild      %8.2f\n", 1e9 * t_rebuild / np);
+    std::printf("  incremental  %8.2f (%zu infectious)\n", 1e9 * t_incremental / np, maintained.size());
+    std::printf("  copy         %8.2f\n", 1e9 * t_copy / np);
+    std::printf("  gather       %8.2f\n", 1e9 * t_gather / np);
+    return 0;
+}